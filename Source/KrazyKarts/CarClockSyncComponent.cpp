@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CarClockSyncComponent.h"
+#include "KrazyKarts.h"
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Clock Offset Error (ms)"), STAT_KrazyKarts_ClockOffsetError, STATGROUP_KrazyKarts);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Clock Round Trip Time (ms)"), STAT_KrazyKarts_ClockRoundTripTime, STATGROUP_KrazyKarts);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Clock Jitter (ms)"), STAT_KrazyKarts_ClockJitter, STATGROUP_KrazyKarts);
+
+// Sets default values for this component's properties
+UCarClockSyncComponent::UCarClockSyncComponent()
+{
+	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
+	// off to improve performance if you don't need them.
+	// only the owning client sends requests, the dedicated server only answers them
+	PrimaryComponentTick.bCanEverTick = !UE_SERVER;
+
+	SetIsReplicated(true);
+}
+
+
+// Called when the game starts
+void UCarClockSyncComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// only the client controlling the kart needs to sync its clock
+	SetComponentTickEnabled(GetOwnerRole() == ROLE_AutonomousProxy);
+	// start syncing as soon as possible
+	TimeSinceRequest = InitialSyncInterval;
+}
+
+
+// Called every frame
+void UCarClockSyncComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	// slew toward the estimate so the synced clock never jumps
+	Offset = FMath::FInterpConstantTo(Offset, TargetOffset, DeltaTime, MaxOffsetSlewRate);
+
+	TimeSinceRequest += DeltaTime;
+	const float Interval = HasSynced() ? SyncInterval : InitialSyncInterval;
+	if (TimeSinceRequest >= Interval)
+	{
+		SendTimeSyncRequest();
+	}
+}
+
+bool UCarClockSyncComponent::HasSynced() const
+{
+	return Samples.Num() >= MinSamplesToSync;
+}
+
+float UCarClockSyncComponent::GetServerTime() const
+{
+	// the server clock is the reference
+	if (GetOwnerRole() == ROLE_Authority) return GetLocalTime();
+	return GetLocalTime() + Offset;
+}
+
+float UCarClockSyncComponent::GetValidationTolerance() const
+{
+	const float Tolerance = BaseValidationTolerance + JitterToleranceMultiplier * ServerClientJitter;
+	return FMath::Min(Tolerance, MaxValidationTolerance);
+}
+
+void UCarClockSyncComponent::SendTimeSyncRequest()
+{
+	TimeSinceRequest = 0;
+	Server_RequestTimeSync(GetLocalTime(), Jitter);
+}
+
+void UCarClockSyncComponent::Server_RequestTimeSync_Implementation(float ClientSendTime, float ClientJitter)
+{
+	// the client measures its jitter, never trust more than the tolerance can take
+	ServerClientJitter = FMath::Clamp(ClientJitter, 0.f, MaxValidationTolerance);
+	Client_ReceiveTimeSync(ClientSendTime, GetLocalTime());
+}
+
+bool UCarClockSyncComponent::Server_RequestTimeSync_Validate(float ClientSendTime, float ClientJitter)
+{
+	return FMath::IsFinite(ClientSendTime) && FMath::IsFinite(ClientJitter) && ClientJitter >= 0;
+}
+
+void UCarClockSyncComponent::Client_ReceiveTimeSync_Implementation(float ClientSendTime, float ServerTime)
+{
+	const float ClientReceiveTime = GetLocalTime();
+	FClockSyncSample Sample;
+	Sample.RoundTripTime = ClientReceiveTime - ClientSendTime;
+	// the server time was read half a round trip before receiving it
+	Sample.Offset = ServerTime + Sample.RoundTripTime / 2 - ClientReceiveTime;
+	AddSample(Sample);
+}
+
+void UCarClockSyncComponent::AddSample(const FClockSyncSample& Sample)
+{
+	if (Sample.RoundTripTime < 0) return;
+	// error of the raw sample against the current estimate
+	if (HasSynced())
+	{
+		SET_FLOAT_STAT(STAT_KrazyKarts_ClockOffsetError, FMath::Abs(Sample.Offset - TargetOffset) * 1000);
+	}
+	// smooth round trip time and its variation
+	if (Samples.Num() == 0)
+	{
+		SmoothedRoundTripTime = Sample.RoundTripTime;
+		Jitter = Sample.RoundTripTime / 2;
+	}
+	else
+	{
+		Jitter = FMath::Lerp(Jitter, FMath::Abs(Sample.RoundTripTime - SmoothedRoundTripTime), SmoothingFactor);
+		SmoothedRoundTripTime = FMath::Lerp(SmoothedRoundTripTime, Sample.RoundTripTime, SmoothingFactor);
+	}
+	// keep the latest samples only
+	Samples.Add(Sample);
+	if (Samples.Num() > MaxSamples)
+	{
+		Samples.RemoveAt(0);
+	}
+	// the sample with the lowest round trip time suffered the least queuing, so its offset is the most accurate
+	const FClockSyncSample* BestSample = &Samples[0];
+	for (const FClockSyncSample& Other: Samples)
+	{
+		if (Other.RoundTripTime < BestSample->RoundTripTime) BestSample = &Other;
+	}
+	TargetOffset = BestSample->Offset;
+	// nothing used the offset before the sync, take the estimate at once
+	if (Samples.Num() <= MinSamplesToSync)
+	{
+		Offset = TargetOffset;
+	}
+
+	SET_FLOAT_STAT(STAT_KrazyKarts_ClockRoundTripTime, SmoothedRoundTripTime * 1000);
+	SET_FLOAT_STAT(STAT_KrazyKarts_ClockJitter, Jitter * 1000);
+}
+
+float UCarClockSyncComponent::GetLocalTime() const
+{
+	const UWorld* World = GetWorld();
+	return World != nullptr ? World->TimeSeconds : 0;
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CarClockSyncComponent.generated.h"
+
+// one round trip of the time sync exchange, measured on the client
+struct FClockSyncSample
+{
+	// round trip time (s)
+	float RoundTripTime;
+	// server time minus client time (s)
+	float Offset;
+};
+
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class KRAZYKARTS_API UCarClockSyncComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+public:
+	// Sets default values for this component's properties
+	UCarClockSyncComponent();
+	// Called every frame
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// ---- synced clock ----
+	// true once the client received enough samples to trust the offset
+	bool HasSynced() const;
+	// estimated server world time, usable on both client and server
+	float GetServerTime() const;
+	// filtered round trip time (s)
+	float GetRoundTripTime() const { return SmoothedRoundTripTime; }
+	// round trip time variation (s)
+	float GetJitter() const { return Jitter; }
+	// ---- validation ----
+	// time the server lets a client run ahead of it before rejecting moves (s)
+	float GetValidationTolerance() const;
+
+private:
+	// ---- time sync exchange ----
+	// ask the server for its time, the client send time is echoed back
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_RequestTimeSync(float ClientSendTime, float ClientJitter);
+	// answer from the server with its current world time
+	UFUNCTION(Client, Unreliable)
+	void Client_ReceiveTimeSync(float ClientSendTime, float ServerTime);
+	void SendTimeSyncRequest();
+	// ---- filter samples ----
+	void AddSample(const FClockSyncSample& Sample);
+	// client local clock
+	float GetLocalTime() const;
+	// latest samples, oldest first
+	TArray<FClockSyncSample> Samples;
+	// offset from the sample with the lowest round trip time
+	float TargetOffset = 0;
+	// offset in use, slewed toward the target
+	float Offset = 0;
+	float SmoothedRoundTripTime = 0;
+	float Jitter = 0;
+	// jitter reported by the owning client, clamped on the server
+	float ServerClientJitter = 0;
+	// time since the last request was sent
+	float TimeSinceRequest = 0;
+	// ---- sync properties ----
+	// interval between requests once synced (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float SyncInterval = 1;
+	// interval between requests until synced (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float InitialSyncInterval = 0.1;
+	// number of samples kept to filter the offset
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	int32 MaxSamples = 8;
+	// number of samples needed before the offset is trusted
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	int32 MinSamplesToSync = 4;
+	// weight of a new sample in the smoothed round trip time and jitter
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float SmoothingFactor = 0.125;
+	// maximum change of the offset per second (s/s)
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float MaxOffsetSlewRate = 0.05;
+	// ---- validation properties ----
+	// tolerance given to every client, whatever its jitter (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float BaseValidationTolerance = 0.05;
+	// how many times the jitter is added to the tolerance
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float JitterToleranceMultiplier = 4;
+	// upper bound of the tolerance so a client cannot buy itself time (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Clock sync")
+	float MaxValidationTolerance = 0.25;
+};
@@ -3,13 +3,15 @@
 
 #include "CarMovementComponent.h"
 #include "GameFramework/GameStateBase.h"
+#include <cmath>
 
 // Sets default values for this component's properties
 UCarMovementComponent::UCarMovementComponent()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
+	// only a locally controlled car simulates on tick, never the case on a dedicated server
+	PrimaryComponentTick.bCanEverTick = !UE_SERVER;
 
 	SetIsReplicated(true);
 }
@@ -19,6 +21,8 @@ UCarMovementComponent::UCarMovementComponent()
 void UCarMovementComponent::BeginPlay()
 {
 	Super::BeginPlay();
+
+	CarClockSyncComponent = GetOwner()->FindComponentByClass<UCarClockSyncComponent>();
 	
 	if (const APawn* Owner = Cast<APawn>(GetOwner()); Owner)
 	{
@@ -67,7 +71,12 @@ FCarMovementInput UCarMovementComponent::CreateInput(const float& DeltaTime)
 	Input.DeltaTime = DeltaTime;
 	Input.Steering = Steering;
 	Input.Throttle = Throttle;
-	if(const UWorld* World = GetWorld())
+	// prefer the clock synced with the server, fallback on the game state coarse sync
+	if(CarClockSyncComponent != nullptr && CarClockSyncComponent->HasSynced())
+	{
+		Input.Timestamp = CarClockSyncComponent->GetServerTime();
+	}
+	else if(const UWorld* World = GetWorld())
 	{
 		Input.Timestamp = World->TimeSeconds;
 		if(const AGameStateBase* GameState = World->GetGameState())
@@ -75,6 +84,9 @@ FCarMovementInput UCarMovementComponent::CreateInput(const float& DeltaTime)
 			Input.Timestamp = GameState->GetServerWorldTimeSeconds();
 		}
 	}
+	// acknowledgement expects strictly increasing timestamps, the synced clock is slewed so only nudge equal stamps
+	Input.Timestamp = FMath::Max(Input.Timestamp, std::nextafter(LastTimestamp, TNumericLimits<float>::Max()));
+	LastTimestamp = Input.Timestamp;
 	return Input;
 }
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "CarClockSyncComponent.h"
 #include "CarMovementComponent.generated.h"
 
 // ustruct necessary for serializing
@@ -55,6 +56,8 @@ public:
 private:
 	// ---- simulate movement ----
 	FCarMovementInput CreateInput(const float& DeltaTime);
+	// timestamp of the last created input
+	float LastTimestamp = 0;
 	bool IsLocallyControlled = false;
 	// ---- state movement ----
 	// throttle to move the car forward, negative for backward
@@ -86,4 +89,7 @@ private:
 	float MaxDrivingForce = 10000;
 	FVector GetAirResistance();
 	FVector GetRollingResistance();
+
+	UPROPERTY()
+	UCarClockSyncComponent* CarClockSyncComponent;
 };
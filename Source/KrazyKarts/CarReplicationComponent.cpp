@@ -4,6 +4,10 @@
 #include "CarReplicationComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "GameFramework/Actor.h"
+#include "KrazyKarts.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Rejected Inputs"), STAT_KrazyKarts_RejectedInputs, STATGROUP_KrazyKarts);
+DECLARE_CYCLE_STAT(TEXT("Simulated Proxy Tick"), STAT_KrazyKarts_SimulatedProxyTick, STATGROUP_KrazyKarts);
 
 // Sets default values for this component's properties
 UCarReplicationComponent::UCarReplicationComponent()
@@ -22,11 +26,18 @@ void UCarReplicationComponent::BeginPlay()
 	Super::BeginPlay();
 
 	CarMovementComponent = GetOwner()->FindComponentByClass<UCarMovementComponent>();
+	CarClockSyncComponent = GetOwner()->FindComponentByClass<UCarClockSyncComponent>();
 
 	if (const APawn* Owner = Cast<APawn>(GetOwner()); Owner)
 	{
 		IsLocallyControlled = Owner->IsLocallyControlled();	
 	}
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		// update the actor faster than the fastest state so no state period is missed, each state then throttles itself
+		GetOwner()->NetUpdateFrequency = NetUpdateRateMultiplier * FMath::Max(AcknowledgeStateUpdateRate, ProxyStateUpdateRate);
+	}
 }
 
 
@@ -52,33 +63,65 @@ void UCarReplicationComponent::TickComponent(float DeltaTime, ELevelTick TickTyp
 	// if I am server and I have control of the kart
 	if(GetOwnerRole() == ROLE_Authority)
 	{
-		// update my own state
-		UpdateAuthoritativeState(LastInput);
+		// states are written right before replication, only follow their periods here
+		AcknowledgeStateTimeSinceUpdate += DeltaTime;
+		ProxyStateTimeSinceUpdate += DeltaTime;
 	}
+#if !UE_SERVER
 	// if I am a kart simulated on a client
 	if(GetOwnerRole() == ROLE_SimulatedProxy)
 	{
 		// run client tick
 		SimulatedProxyTick(DeltaTime);
 	}
+#endif
 }
 
-void UCarReplicationComponent::ClearAcknowledgedInputs(const FCarMovementInput& LastInput)
+void UCarReplicationComponent::ClearAcknowledgedInputs(float AcknowledgedTimestamp)
 {
 	TArray<FCarMovementInput> NewUnacknowledgedInputs;
 	for (const FCarMovementInput& Input: UnacknowledgedInputs)
 	{
-		if(Input.Timestamp > LastInput.Timestamp) NewUnacknowledgedInputs.Add(Input);
+		if(Input.Timestamp > AcknowledgedTimestamp) NewUnacknowledgedInputs.Add(Input);
 	}
 	UnacknowledgedInputs = NewUnacknowledgedInputs;
 }
 
+void UCarReplicationComponent::SetMeshOffsetRoot(USceneComponent* Value)
+{
+	MeshOffsetRoot = Value;
+	if(MeshOffsetRoot != nullptr)
+	{
+		MeshOffsetRootRelativeTransform = MeshOffsetRoot->GetRelativeTransform();
+	}
+}
+
+void UCarReplicationComponent::SetSimulationLOD(ECarSimulationLOD Value)
+{
+	if (SimulationLOD == Value) return;
+	// waking up, the time since the last update is unknown, wait for two fresh updates before interpolating
+	if (SimulationLOD == ECarSimulationLOD::Dormant)
+	{
+		SimulatedProxyTimeBetweenLastUpdates = 0;
+		SimulatedProxyWaitingForUpdate = true;
+	}
+	SimulationLOD = Value;
+}
+
 void UCarReplicationComponent::SimulatedProxyTick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKarts_SimulatedProxyTick);
+
 	SimulatedProxyTimeSinceUpdate += DeltaTime;
 
 	if (SimulatedProxyTimeBetweenLastUpdates < KINDA_SMALL_NUMBER) return;
 
+	if (SimulationLOD == ECarSimulationLOD::Linear)
+	{
+		InterpolateLinear(FMath::Min(SimulatedProxyTimeSinceUpdate / SimulatedProxyTimeBetweenLastUpdates, 1.f));
+		return;
+	}
+
 	// create spline
 	FHermiteCubicSpline Spline = CreateSpline();
 	// calculate lerp ratio
@@ -93,9 +136,9 @@ FHermiteCubicSpline UCarReplicationComponent::CreateSpline()
 {
 	FHermiteCubicSpline Spline;
 	Spline.StartLocation = SimulatedProxyStartTransform.GetLocation();
-	Spline.TargetLocation = AuthoritativeState.Transform.GetLocation();
+	Spline.TargetLocation = ProxyState.Location;
 	Spline.StartDerivative = SimulatedProxyStartVelocity * VelocityToDerivative();
-	Spline.TargetDerivative = AuthoritativeState.Velocity * VelocityToDerivative();
+	Spline.TargetDerivative = ProxyState.Velocity * VelocityToDerivative();
 	return Spline;
 }
 
@@ -129,7 +172,7 @@ void UCarReplicationComponent::InterpolateVelocity(const FHermiteCubicSpline& Sp
 void UCarReplicationComponent::InterpolateRotation(const float& LerpRatio)
 {
 	// calculate new rotation from start rotation to target rotation
-	FQuat NewRotation = FQuat::Slerp(SimulatedProxyStartTransform.GetRotation(), AuthoritativeState.Transform.GetRotation(), LerpRatio);
+	FQuat NewRotation = FQuat::Slerp(SimulatedProxyStartTransform.GetRotation(), ProxyState.Rotation.Quaternion(), LerpRatio);
 	if(MeshOffsetRoot != nullptr)
 	{
 		// set new transform
@@ -137,34 +180,91 @@ void UCarReplicationComponent::InterpolateRotation(const float& LerpRatio)
 	}
 }
 
-void UCarReplicationComponent::UpdateAuthoritativeState(const FCarMovementInput& Input)
+void UCarReplicationComponent::InterpolateLinear(const float& LerpRatio)
+{
+	// straight line and no velocity derivative, the kart is too far to notice
+	const FVector NewLocation = FMath::Lerp(SimulatedProxyStartTransform.GetLocation(), FVector(ProxyState.Location), LerpRatio);
+	CarMovementComponent->SetVelocity(FMath::Lerp(SimulatedProxyStartVelocity, FVector(ProxyState.Velocity), LerpRatio));
+	InterpolateRotation(LerpRatio);
+	if(MeshOffsetRoot != nullptr)
+	{
+		MeshOffsetRoot->SetWorldLocation(NewLocation);
+	}
+}
+
+void UCarReplicationComponent::SnapMeshOffsetRoot()
 {
-	// set the state for the car owned by the server
-	AuthoritativeState.LastInput = Input;
-	AuthoritativeState.Transform = GetOwner()->GetActorTransform();
-	AuthoritativeState.Velocity = CarMovementComponent->GetVelocity();
+	if(MeshOffsetRoot != nullptr)
+	{
+		MeshOffsetRoot->SetRelativeTransform(MeshOffsetRootRelativeTransform);
+	}
 }
 
-void UCarReplicationComponent::OnRep_AuthoritativeState()
+void UCarReplicationComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
 {
-	switch(GetOwnerRole())
+	Super::PreReplication(ChangedPropertyTracker);
+
+	if(CarMovementComponent == nullptr) return;
+	// write the states now so the latest pose is sent
+	if (ConsumeUpdatePeriod(AcknowledgeStateTimeSinceUpdate, AcknowledgeStateUpdateRate))
 	{
-	case ROLE_AutonomousProxy:
-		OnRep_AutonomousProxy_AuthoritativeState();
-		break;
-	case ROLE_SimulatedProxy:
-		OnRep_SimulatedProxy_AuthoritativeState();
-		break;
-	default:
-		break;
+		UpdateAcknowledgeState(CarMovementComponent->GetLastInput());
 	}
+	if (ConsumeUpdatePeriod(ProxyStateTimeSinceUpdate, ProxyStateUpdateRate))
+	{
+		UpdateProxyState();
+	}
+}
+
+bool UCarReplicationComponent::ConsumeUpdatePeriod(float& TimeSinceUpdate, float UpdateRate)
+{
+	const float Period = 1 / UpdateRate;
+	if (TimeSinceUpdate < Period) return false;
+	// carry the remainder so the average period stays exact, without bursting after a hitch
+	TimeSinceUpdate = FMath::Min(TimeSinceUpdate - Period, Period);
+	return true;
+}
+
+void UCarReplicationComponent::UpdateAcknowledgeState(const FCarMovementInput& Input)
+{
+	// set the state acknowledging the owner inputs
+	AcknowledgeState.LastInputTimestamp = Input.Timestamp;
+	AcknowledgeState.Velocity = CarMovementComponent->GetVelocity();
+	AcknowledgeState.Location = GetOwner()->GetActorLocation();
+	AcknowledgeState.Rotation = GetOwner()->GetActorQuat();
+}
+
+void UCarReplicationComponent::UpdateProxyState()
+{
+	// set the pose seen by the other clients
+	ProxyState.Location = GetOwner()->GetActorLocation();
+	ProxyState.Rotation = GetOwner()->GetActorRotation();
+	ProxyState.Velocity = CarMovementComponent->GetVelocity();
+	ProxyState.ServerTime = GetWorld()->TimeSeconds;
 }
 
-void UCarReplicationComponent::OnRep_SimulatedProxy_AuthoritativeState()
+void UCarReplicationComponent::OnRep_ProxyState()
 {
 	if(CarMovementComponent == nullptr) return;
+	// the interval between updates is measured on the server, idle time on the client does not count
+	const float TimeBetweenUpdates = SimulatedProxyLastServerTime >= 0 ? ProxyState.ServerTime - SimulatedProxyLastServerTime : 0;
+	SimulatedProxyLastServerTime = ProxyState.ServerTime;
+	// a dormant kart does not tick, jump to the state
+	// the first update after waking up also jumps, it only starts the timing of the next one
+	if (SimulationLOD == ECarSimulationLOD::Dormant || SimulatedProxyWaitingForUpdate)
+	{
+		GetOwner()->SetActorLocationAndRotation(ProxyState.Location, ProxyState.Rotation);
+		CarMovementComponent->SetVelocity(ProxyState.Velocity);
+		SnapMeshOffsetRoot();
+		if (SimulationLOD != ECarSimulationLOD::Dormant)
+		{
+			SimulatedProxyWaitingForUpdate = false;
+			SimulatedProxyTimeSinceUpdate = 0;
+		}
+		return;
+	}
 	// set time between updates
-	SimulatedProxyTimeBetweenLastUpdates = SimulatedProxyTimeSinceUpdate;
+	SimulatedProxyTimeBetweenLastUpdates = TimeBetweenUpdates;
 	// just receive update so reset
 	SimulatedProxyTimeSinceUpdate = 0;
 	// just make sure it is high enough
@@ -178,19 +278,19 @@ void UCarReplicationComponent::OnRep_SimulatedProxy_AuthoritativeState()
 	// set start velocity
 	SimulatedProxyStartVelocity = CarMovementComponent->GetVelocity();
 	// set the transform of the meshoffsetroot
-	GetOwner()->SetActorTransform(AuthoritativeState.Transform);
+	GetOwner()->SetActorLocationAndRotation(ProxyState.Location, ProxyState.Rotation);
 }
 
-void UCarReplicationComponent::OnRep_AutonomousProxy_AuthoritativeState()
+void UCarReplicationComponent::OnRep_AcknowledgeState()
 {
-	// on replicate authoritative state received by the client
+	// on replicate acknowledge state received by the client
 	if(CarMovementComponent == nullptr) return;
 	// when receiving new state on the client from the server
-	// reset state from authoritative state
-	GetOwner()->SetActorTransform(AuthoritativeState.Transform);
-	CarMovementComponent->SetVelocity(AuthoritativeState.Velocity);
+	// reset state from acknowledge state
+	GetOwner()->SetActorLocationAndRotation(AcknowledgeState.Location, AcknowledgeState.Rotation);
+	CarMovementComponent->SetVelocity(AcknowledgeState.Velocity);
 	// clear acknowledged inputs
-	ClearAcknowledgedInputs(AuthoritativeState.LastInput);
+	ClearAcknowledgedInputs(AcknowledgeState.LastInputTimestamp);
 	// simulate unacknowledged input
 	for (const FCarMovementInput& Input: UnacknowledgedInputs)
 	{
@@ -200,6 +300,18 @@ void UCarReplicationComponent::OnRep_AutonomousProxy_AuthoritativeState()
 
 void UCarReplicationComponent::Server_SendInput_Implementation(const FCarMovementInput& Input)
 {
+	// start following the client time from the server time of its first move, not from zero
+	if (!SimulatedProxyHasReceivedInput)
+	{
+		SimulatedProxyHasReceivedInput = true;
+		SimulatedProxySimulatedTime = GetWorld()->TimeSeconds - Input.DeltaTime;
+	}
+	// drop the move instead of kicking the client, the next authoritative state corrects it
+	if (!IsInputInTimeBudget(Input))
+	{
+		INC_DWORD_STAT(STAT_KrazyKarts_RejectedInputs);
+		return;
+	}
 	SimulatedProxySimulatedTime += Input.DeltaTime;
 	if(CarMovementComponent == nullptr) return;
 	// simulate the move on the server
@@ -207,10 +319,16 @@ void UCarReplicationComponent::Server_SendInput_Implementation(const FCarMovemen
 }
 
 bool UCarReplicationComponent::Server_SendInput_Validate(const FCarMovementInput& Input)
+{
+	return Input.IsValid();
+}
+
+bool UCarReplicationComponent::IsInputInTimeBudget(const FCarMovementInput& Input) const
 {
 	const float ProposedTime = SimulatedProxySimulatedTime + Input.DeltaTime;
-	bool SimulatedProxyNotRunningAheadOfTime = ProposedTime < GetWorld()->TimeSeconds;
-	return Input.IsValid() && SimulatedProxyNotRunningAheadOfTime;
+	// allow the client to run ahead by the tolerance measured from its jitter
+	const float Tolerance = CarClockSyncComponent != nullptr ? CarClockSyncComponent->GetValidationTolerance() : 0;
+	return ProposedTime < GetWorld()->TimeSeconds + Tolerance;
 }
 
 void UCarReplicationComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -218,7 +336,9 @@ void UCarReplicationComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProper
 	// call the super
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	// ---- replicate variables ----
-	// replicate state
-	DOREPLIFETIME(UCarReplicationComponent, AuthoritativeState);
+	// replicate acknowledgement to the owner only
+	DOREPLIFETIME_CONDITION(UCarReplicationComponent, AcknowledgeState, COND_OwnerOnly);
+	// replicate pose to everyone else
+	DOREPLIFETIME_CONDITION(UCarReplicationComponent, ProxyState, COND_SkipOwner);
 }
 
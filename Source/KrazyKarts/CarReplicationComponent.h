@@ -5,20 +5,57 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "CarMovementComponent.h"
+#include "CarClockSyncComponent.h"
+#include "Engine/NetSerialization.h"
 #include "CarReplicationComponent.generated.h"
 
-// ustruct necessary for serializing
+// state replicated to the owning client only, to acknowledge inputs and correct its prediction
 USTRUCT()
-struct FCarMovementState
+struct FCarAcknowledgeState
 {
 	GENERATED_USTRUCT_BODY();
 
 	UPROPERTY()
-	FCarMovementInput LastInput;
+	float LastInputTimestamp;
 	UPROPERTY()
 	FVector Velocity;
 	UPROPERTY()
-	FTransform Transform;
+	FVector Location;
+	UPROPERTY()
+	FQuat Rotation;
+};
+
+// state replicated to every client but the owner, only what interpolation needs
+USTRUCT()
+struct FCarProxyState
+{
+	GENERATED_USTRUCT_BODY();
+
+	// quantized to the centimeter hundredth
+	UPROPERTY()
+	FVector_NetQuantize100 Location;
+	// compressed to shorts
+	UPROPERTY()
+	FRotator Rotation;
+	UPROPERTY()
+	FVector_NetQuantize100 Velocity;
+	// server time of the write, changes every update even when the kart stands still
+	UPROPERTY()
+	float ServerTime;
+};
+
+// how much work a simulated proxy does to follow its replicated state
+UENUM()
+enum class ECarSimulationLOD : uint8
+{
+	// cubic interpolation every frame
+	Full,
+	// cubic interpolation at a lower tick rate
+	Reduced,
+	// linear interpolation at a low tick rate
+	Linear,
+	// no tick, snap to each replicated state
+	Dormant
 };
 
 struct FHermiteCubicSpline
@@ -52,30 +89,56 @@ public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	// Override Replicate Properties function
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// Called on the server right before the owner is replicated
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 	UFUNCTION(BlueprintCallable)
-	void SetMeshOffsetRoot(USceneComponent* Value) { MeshOffsetRoot = Value; }
+	void SetMeshOffsetRoot(USceneComponent* Value);
+	// ---- simulated proxy level of detail ----
+	void SetSimulationLOD(ECarSimulationLOD Value);
+	ECarSimulationLOD GetSimulationLOD() const { return SimulationLOD; }
 
 private:
 	// ---- authoritative state, send and receive ----
-	UPROPERTY(ReplicatedUsing=OnRep_AuthoritativeState)
-	FCarMovementState AuthoritativeState;
-	void UpdateAuthoritativeState(const FCarMovementInput& Input);
+	// owner only acknowledgement and correction
+	UPROPERTY(ReplicatedUsing=OnRep_AcknowledgeState)
+	FCarAcknowledgeState AcknowledgeState;
+	void UpdateAcknowledgeState(const FCarMovementInput& Input);
 	UFUNCTION()
-	void OnRep_AuthoritativeState();
-	void OnRep_SimulatedProxy_AuthoritativeState();
-	void OnRep_AutonomousProxy_AuthoritativeState();
+	void OnRep_AcknowledgeState();
+	// everyone but the owner pose and velocity
+	UPROPERTY(ReplicatedUsing=OnRep_ProxyState)
+	FCarProxyState ProxyState;
+	void UpdateProxyState();
+	UFUNCTION()
+	void OnRep_ProxyState();
+	// time since the states were last written on the server
+	float AcknowledgeStateTimeSinceUpdate = 0;
+	float ProxyStateTimeSinceUpdate = 0;
+	// true if a state period elapsed, the remainder is kept for the next one
+	bool ConsumeUpdatePeriod(float& TimeSinceUpdate, float UpdateRate);
+	// frequency the owning client receives its acknowledgement (Hz)
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (ClampMin = "0.1"))
+	float AcknowledgeStateUpdateRate = 1;
+	// frequency the other clients receive the kart pose (Hz)
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (ClampMin = "0.1"))
+	float ProxyStateUpdateRate = 1;
+	// actor net update frequency relative to the fastest state rate
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (ClampMin = "1"))
+	float NetUpdateRateMultiplier = 2;
 	bool IsLocallyControlled = false;
 	// send input from client to server
 	UFUNCTION(Server, Reliable, WithValidation)
 	void Server_SendInput(const FCarMovementInput& Input);
 	// ---- history inputs ----
 	TArray<FCarMovementInput> UnacknowledgedInputs;
-	void ClearAcknowledgedInputs(const FCarMovementInput& LastInput);
+	void ClearAcknowledgedInputs(float AcknowledgedTimestamp);
 	// ---- simulated proxy interpolate ----
 	// time since last update
 	float SimulatedProxyTimeSinceUpdate;
 	// time between the updates
 	float SimulatedProxyTimeBetweenLastUpdates;
+	// server time of the last update, negative until the first one
+	float SimulatedProxyLastServerTime = -1;
 	// starting location
 	FTransform SimulatedProxyStartTransform;
 	// starting velocity
@@ -89,12 +152,27 @@ private:
 	void InterpolateLocation(const FHermiteCubicSpline& Spline, const float& LerpRatio);
 	void InterpolateVelocity(const FHermiteCubicSpline& Spline, const float& LerpRatio);
 	void InterpolateRotation(const float& LerpRatio);
+	// cheap interpolation used by far karts
+	void InterpolateLinear(const float& LerpRatio);
+	// put the mesh back on the actor
+	void SnapMeshOffsetRoot();
+	ECarSimulationLOD SimulationLOD = ECarSimulationLOD::Full;
+	// true after waking up until the first update is received
+	bool SimulatedProxyWaitingForUpdate = false;
 	// follow the time spent on the server
 	float SimulatedProxySimulatedTime = 0;
+	// true once the first move anchored the simulated time to the server time
+	bool SimulatedProxyHasReceivedInput = false;
+	// true if the move does not make the client run ahead of the server
+	bool IsInputInTimeBudget(const FCarMovementInput& Input) const;
 	
 
 	UPROPERTY()
 	UCarMovementComponent* CarMovementComponent;
 	UPROPERTY()
+	UCarClockSyncComponent* CarClockSyncComponent;
+	UPROPERTY()
 	USceneComponent* MeshOffsetRoot;
+	// transform of the mesh offset root relative to the actor when it is not interpolating
+	FTransform MeshOffsetRootRelativeTransform;
 };
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CarSignificanceComponent.h"
+#include "KrazyKarts.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Evaluate Significance"), STAT_KrazyKarts_EvaluateSignificance, STATGROUP_KrazyKarts);
+
+static TAutoConsoleVariable<int32> CVarForceSimulationLOD(
+	TEXT("KrazyKarts.ForceSimulationLOD"),
+	-1,
+	TEXT("Force the level of detail of every simulated proxy kart.\n")
+	TEXT("-1: evaluate from significance, 0: full, 1: reduced, 2: linear, 3: dormant"));
+
+// Sets default values for this component's properties
+UCarSignificanceComponent::UCarSignificanceComponent()
+{
+	// only simulated proxies on clients need a level of detail
+	PrimaryComponentTick.bCanEverTick = !UE_SERVER;
+}
+
+
+// Called when the game starts
+void UCarSignificanceComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	CarMovementComponent = GetOwner()->FindComponentByClass<UCarMovementComponent>();
+	CarReplicationComponent = GetOwner()->FindComponentByClass<UCarReplicationComponent>();
+
+	// the server and the owning client always simulate at full rate
+	SetComponentTickEnabled(GetOwnerRole() == ROLE_SimulatedProxy);
+	SetComponentTickInterval(EvaluationInterval);
+}
+
+
+// Called every EvaluationInterval
+void UCarSignificanceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if(CarReplicationComponent == nullptr) return;
+
+	const int32 ForcedLOD = CVarForceSimulationLOD.GetValueOnGameThread();
+	if (ForcedLOD >= 0 && ForcedLOD <= static_cast<int32>(ECarSimulationLOD::Dormant))
+	{
+		ApplyLOD(static_cast<ECarSimulationLOD>(ForcedLOD));
+	}
+	else
+	{
+		ApplyLOD(EvaluateLOD());
+	}
+}
+
+ECarSimulationLOD UCarSignificanceComponent::EvaluateLOD() const
+{
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKarts_EvaluateSignificance);
+
+	// score against the view of the local player
+	const APlayerController* Controller = GetWorld()->GetFirstPlayerController();
+	if (Controller == nullptr || Controller->PlayerCameraManager == nullptr) return ECarSimulationLOD::Full;
+	const APlayerCameraManager* Camera = Controller->PlayerCameraManager;
+	const AActor* Owner = GetOwner();
+
+	const float Distance = FVector::Dist(Camera->GetCameraLocation(), Owner->GetActorLocation());
+	// hidden and far enough to not pop in before the next evaluation
+	if (!Owner->WasRecentlyRendered(HiddenDelay) && Distance > DormantMinDistance)
+	{
+		return ECarSimulationLOD::Dormant;
+	}
+	// share of the view height covered by the kart
+	const float HalfFOVTan = FMath::Tan(FMath::DegreesToRadians(Camera->GetFOVAngle() / 2));
+	const float ScreenSize = Owner->GetSimpleCollisionRadius() / FMath::Max(Distance * HalfFOVTan, KINDA_SMALL_NUMBER);
+	if (ScreenSize < LinearScreenSize) return ECarSimulationLOD::Linear;
+	if (ScreenSize < ReducedScreenSize) return ECarSimulationLOD::Reduced;
+	return ECarSimulationLOD::Full;
+}
+
+void UCarSignificanceComponent::ApplyLOD(ECarSimulationLOD LOD)
+{
+	if (CarReplicationComponent->GetSimulationLOD() == LOD) return;
+	CarReplicationComponent->SetSimulationLOD(LOD);
+
+	// a dormant kart stops ticking until this component wakes it up
+	const float TickInterval = GetTickInterval(LOD);
+	const bool ShouldTick = TickInterval >= 0;
+	AActor* Owner = GetOwner();
+	Owner->SetActorTickEnabled(ShouldTick);
+	CarReplicationComponent->SetComponentTickEnabled(ShouldTick);
+	if (CarMovementComponent != nullptr) CarMovementComponent->SetComponentTickEnabled(ShouldTick);
+	if (!ShouldTick) return;
+	Owner->SetActorTickInterval(TickInterval);
+	CarReplicationComponent->SetComponentTickInterval(TickInterval);
+	if (CarMovementComponent != nullptr) CarMovementComponent->SetComponentTickInterval(TickInterval);
+}
+
+float UCarSignificanceComponent::GetTickInterval(ECarSimulationLOD LOD) const
+{
+	switch(LOD)
+	{
+	case ECarSimulationLOD::Full:
+		return 0;
+	case ECarSimulationLOD::Reduced:
+		return ReducedTickInterval;
+	case ECarSimulationLOD::Linear:
+		return LinearTickInterval;
+	case ECarSimulationLOD::Dormant:
+	default:
+		return -1;
+	}
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CarMovementComponent.h"
+#include "CarReplicationComponent.h"
+#include "CarSignificanceComponent.generated.h"
+
+
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class KRAZYKARTS_API UCarSignificanceComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+public:
+	// Sets default values for this component's properties
+	UCarSignificanceComponent();
+	// Called every EvaluationInterval
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	// ---- evaluate significance ----
+	ECarSimulationLOD EvaluateLOD() const;
+	// ---- apply level of detail ----
+	void ApplyLOD(ECarSimulationLOD LOD);
+	// tick interval of the kart for a level of detail, negative to stop ticking
+	float GetTickInterval(ECarSimulationLOD LOD) const;
+	// ---- significance properties ----
+	// time between two evaluations (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float EvaluationInterval = 0.25;
+	// below this screen size the kart ticks at a reduced rate
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float ReducedScreenSize = 0.1;
+	// below this screen size the kart interpolates linearly
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float LinearScreenSize = 0.03;
+	// a hidden kart closer than this keeps ticking, it can show up any time (cm)
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float DormantMinDistance = 3000;
+	// time without being rendered before a kart is considered hidden (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float HiddenDelay = 0.5;
+	// tick interval at reduced level of detail (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float ReducedTickInterval = 1.f / 30;
+	// tick interval at linear level of detail (s)
+	UPROPERTY(EditDefaultsOnly, Category = "Significance")
+	float LinearTickInterval = 1.f / 15;
+
+	UPROPERTY()
+	UCarMovementComponent* CarMovementComponent;
+	UPROPERTY()
+	UCarReplicationComponent* CarReplicationComponent;
+};
@@ -2,23 +2,30 @@
 
 
 #include "GoKart.h"
+#include "Engine/World.h"
+#if !UE_SERVER
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
-#include "Engine/World.h"
 #include "DrawDebugHelpers.h"
+#endif
 
 
 // Sets default values
 AGoKart::AGoKart()
 {
  	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// the actor tick only draws debug, the dedicated server simulates and replicates in the components
+	PrimaryActorTick.bCanEverTick = !UE_SERVER;
 
 	bReplicates = true;
 	// create the movement component
 	CarMovementComponent = CreateDefaultSubobject<UCarMovementComponent>(TEXT("CarMovementComponent"));
 	// create the replication component
 	CarReplicationComponent = CreateDefaultSubobject<UCarReplicationComponent>(TEXT("CarReplicationComponent"));
+	// create the clock sync component
+	CarClockSyncComponent = CreateDefaultSubobject<UCarClockSyncComponent>(TEXT("CarClockSyncComponent"));
+	// create the significance component
+	CarSignificanceComponent = CreateDefaultSubobject<UCarSignificanceComponent>(TEXT("CarSignificanceComponent"));
 }
 
 // Called when the game starts or when spawned
@@ -27,15 +34,9 @@ void AGoKart::BeginPlay()
 	Super::BeginPlay();
 	// deactivate to use our own replicate movement
 	SetReplicateMovement(false);
-
-	if(HasAuthority())
-	{
-		// define the frequency to update replicated properties
-		NetUpdateFrequency = 1;
-	}
-	
 }
 
+#if !UE_SERVER
 FString GetEnumText(const ENetRole& Role)
 {
 	switch(Role)
@@ -52,6 +53,7 @@ FString GetEnumText(const ENetRole& Role)
 		return "Error";
 	}
 }
+#endif
 
 
 
@@ -59,14 +61,16 @@ FString GetEnumText(const ENetRole& Role)
 void AGoKart::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+#if !UE_SERVER
 	DrawDebugString(GetWorld(), FVector(0, 0, 100), GetEnumText(GetLocalRole()), this, FColor::White, DeltaTime);
+#endif
 }
 
 // Called to bind functionality to input
 void AGoKart::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
-
+#if !UE_SERVER
 	// get controller as player controller
 	if(APlayerController* Controller = Cast<APlayerController>(GetController()); Controller)
 	{
@@ -86,6 +90,7 @@ void AGoKart::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 			}
 		}
 	}
+#endif
 }
 
 void AGoKart::ActThrottle(const FInputActionInstance& Instance)
@@ -8,6 +8,8 @@
 #include "InputMappingContext.h"
 #include "CarMovementComponent.h"
 #include "CarReplicationComponent.h"
+#include "CarClockSyncComponent.h"
+#include "CarSignificanceComponent.h"
 #include "GoKart.generated.h"
 
 
@@ -36,6 +38,12 @@ public:
 	// ---- replicate ----
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	UCarReplicationComponent* CarReplicationComponent;
+	// ---- sync clock with server ----
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	UCarClockSyncComponent* CarClockSyncComponent;
+	// ---- level of detail of simulated proxies ----
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	UCarSignificanceComponent* CarSignificanceComponent;
 
 private:
 
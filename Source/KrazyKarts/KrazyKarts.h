@@ -3,4 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+// stats of the karts, display them with 'stat KrazyKarts'
+DECLARE_STATS_GROUP(TEXT("KrazyKarts"), STATGROUP_KrazyKarts, STATCAT_Advanced);
 